@@ -21,11 +21,13 @@
 #define MAX_NR_BNEP_SERVICES 1
 #define MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES  2
 #define MAX_NR_GATT_CLIENTS 1
-#define MAX_NR_HCI_CONNECTIONS 2
+#define MAX_NR_HCI_CONNECTIONS (MAX_NR_HID_HOST_CONNECTIONS + 1)
+// > 1 merges the devices into one USB device
 #define MAX_NR_HID_HOST_CONNECTIONS 1
 #define MAX_NR_HIDS_CLIENTS 1
 #define MAX_NR_HFP_CONNECTIONS 1
-#define MAX_NR_L2CAP_CHANNELS  4
+// control + interrupt channel for each HID device, SDP
+#define MAX_NR_L2CAP_CHANNELS  (MAX_NR_HID_HOST_CONNECTIONS * 2 + 2)
 #define MAX_NR_L2CAP_SERVICES  3
 #define MAX_NR_RFCOMM_CHANNELS 1
 #define MAX_NR_RFCOMM_MULTIPLEXERS 1
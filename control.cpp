@@ -0,0 +1,207 @@
+// not btstack.h, both it and tinyusb define hid_report_type_t
+#include "tusb.h"
+
+#include "control.hpp"
+#include "usb.hpp"
+
+// simple binary protocol over the CDC interface
+// request:  [command] [payload len] [payload...]
+// response: [command | 0x80] [status] [payload len] [payload...]
+// multi-byte values are little-endian
+
+#define CONTROL_PROTOCOL_VERSION 1
+#define MAX_PAYLOAD_SIZE 16
+#define MAX_RESPONSE_SIZE (3 + 28)
+
+enum class Command : uint8_t
+{
+    GetVersion = 0,
+    GetStats,
+    ResetStats,
+    GetConfig,
+    SetConfig, // [key] [value]
+    Rescan,
+    Reconnect,
+};
+
+enum class Status : uint8_t
+{
+    OK = 0,
+    UnknownCommand,
+    BadLength,
+    BadValue,
+    Unavailable, // action can't be done in the current state
+};
+
+enum class ConfigKey : uint8_t
+{
+    ReportPolicy = 0,
+    ReportQueueDepth,
+    InquiryInterval,
+    HIDReportMode,
+};
+
+static BTConfig *bt_config = nullptr;
+static ControlActionHandler action_handler = nullptr;
+
+static uint8_t rx_buf[2 + MAX_PAYLOAD_SIZE];
+static unsigned rx_len = 0;
+
+static uint8_t tx_buf[MAX_RESPONSE_SIZE];
+
+static uint8_t *write_u32(uint8_t *ptr, uint32_t val)
+{
+    *ptr++ = val;
+    *ptr++ = val >> 8;
+    *ptr++ = val >> 16;
+    *ptr++ = val >> 24;
+    return ptr;
+}
+
+static void send_response(Command command, Status status, uint8_t payload_len)
+{
+    tx_buf[0] = uint8_t(command) | 0x80;
+    tx_buf[1] = uint8_t(status);
+    tx_buf[2] = payload_len;
+
+    tud_cdc_write(tx_buf, 3 + payload_len);
+    tud_cdc_write_flush();
+}
+
+static Status set_config(ConfigKey key, uint8_t value)
+{
+    switch(key)
+    {
+        case ConfigKey::ReportPolicy:
+            if(value > uint8_t(ReportPolicy::Coalesce))
+                return Status::BadValue;
+
+            usb_set_report_policy(ReportPolicy(value));
+            return Status::OK;
+
+        case ConfigKey::ReportQueueDepth:
+            return usb_set_report_queue_depth(value) ? Status::OK : Status::BadValue;
+
+        case ConfigKey::InquiryInterval:
+            // 1.28 - 61.44s
+            if(value < 1 || value > 0x30)
+                return Status::BadValue;
+
+            bt_config->inquiry_interval = value;
+            return Status::OK;
+
+        case ConfigKey::HIDReportMode:
+            // boot, report, report with fallback to boot
+            if(value > 2)
+                return Status::BadValue;
+
+            bt_config->report_mode = value;
+            return Status::OK;
+    }
+
+    return Status::BadValue;
+}
+
+static void handle_command(Command command, const uint8_t *payload, uint8_t payload_len)
+{
+    auto status = Status::OK;
+    auto out = tx_buf + 3;
+
+    switch(command)
+    {
+        case Command::GetVersion:
+            *out++ = CONTROL_PROTOCOL_VERSION;
+            break;
+
+        case Command::GetStats:
+        {
+            USBStats stats;
+            usb_get_stats(stats);
+
+            out = write_u32(out, stats.reports_queued);
+            out = write_u32(out, stats.reports_sent);
+            out = write_u32(out, stats.reports_dropped);
+            out = write_u32(out, stats.reports_coalesced);
+            out = write_u32(out, stats.reports_sent ? stats.latency_min_us : 0);
+            out = write_u32(out, stats.latency_max_us);
+            out = write_u32(out, stats.latency_total_us);
+            break;
+        }
+
+        case Command::ResetStats:
+            usb_reset_stats();
+            break;
+
+        case Command::GetConfig:
+            *out++ = uint8_t(usb_get_report_policy());
+            *out++ = usb_get_report_queue_depth();
+            *out++ = bt_config->inquiry_interval;
+            *out++ = bt_config->report_mode;
+            break;
+
+        case Command::SetConfig:
+            if(payload_len != 2)
+                status = Status::BadLength;
+            else
+                status = set_config(ConfigKey(payload[0]), payload[1]);
+            break;
+
+        case Command::Rescan:
+            if(!action_handler(ControlAction::Rescan))
+                status = Status::Unavailable;
+            break;
+
+        case Command::Reconnect:
+            if(!action_handler(ControlAction::Reconnect))
+                status = Status::Unavailable;
+            break;
+
+        default:
+            status = Status::UnknownCommand;
+            break;
+    }
+
+    // don't return partial data on error
+    send_response(command, status, status == Status::OK ? out - (tx_buf + 3) : 0);
+}
+
+void control_init(BTConfig *config, ControlActionHandler handler)
+{
+    bt_config = config;
+    action_handler = handler;
+}
+
+void control_update()
+{
+    if(!tud_cdc_connected())
+    {
+        rx_len = 0;
+        return;
+    }
+
+    // wait until there's room for any response
+    if(tud_cdc_write_available() < MAX_RESPONSE_SIZE)
+        return;
+
+    // read the header, then the payload
+    unsigned want = rx_len < 2 ? 2 : 2 + rx_buf[1];
+
+    if(rx_len < want)
+        rx_len += tud_cdc_read(rx_buf + rx_len, want - rx_len);
+
+    if(rx_len == 2 && rx_buf[1] > MAX_PAYLOAD_SIZE)
+    {
+        // can't buffer this, reject and drop whatever's left
+        send_response(Command(rx_buf[0]), Status::BadLength, 0);
+        tud_cdc_read_flush();
+        rx_len = 0;
+        return;
+    }
+
+    if(rx_len < 2 || rx_len < 2u + rx_buf[1])
+        return;
+
+    // only one command per update
+    handle_command(Command(rx_buf[0]), rx_buf + 2, rx_buf[1]);
+    rx_len = 0;
+}
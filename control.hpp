@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// bt settings that can be changed over the control interface
+struct BTConfig
+{
+    uint8_t inquiry_interval; // in 1.28s units
+    uint8_t report_mode;      // hid_protocol_mode_t, used for the next connection
+};
+
+enum class ControlAction
+{
+    Rescan,
+    Reconnect
+};
+
+// returns false if the action can't be done right now
+using ControlActionHandler = bool (*)(ControlAction action);
+
+void control_init(BTConfig *bt_config, ControlActionHandler action_handler);
+
+// handles a command from the CDC interface, call after usb_update
+void control_update();
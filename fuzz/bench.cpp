@@ -0,0 +1,116 @@
+// rough host timings for the per-report and per-descriptor paths
+// usage: bench [iterations]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+
+#include "btstack.h"
+
+#include "hid_descriptor.hpp"
+#include "merge.hpp"
+#include "pnp_info.hpp"
+#include "quirks.hpp"
+#include "usb.hpp"
+
+// gamepad with two report IDs, 8 and 10 bytes
+static const uint8_t test_descriptor[]
+{
+    0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+    0x85, 0x01,
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x10, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x10, 0x81, 0x02,
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x06, 0x81, 0x02,
+    0x85, 0x02,
+    0x06, 0x00, 0xFF, 0x09, 0x01, 0x75, 0x08, 0x95, 0x0A, 0x81, 0x02,
+    0xC0,
+};
+
+template<class F>
+static void bench(const char *name, const char *unit, unsigned iterations, F func)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for(unsigned i = 0; i < iterations; i++)
+        func(i);
+
+    auto end = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    printf("%-32s %8.1f ns/%s\n", name, ns / iterations, unit);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    if(!iterations)
+        iterations = 1;
+
+    uint8_t report[]{0x01, 0, 0, 0x80, 0x80, 0x80, 0x80, 0, 0};
+
+    // descriptors
+    HIDDescriptorInfo info;
+    bench("hid_parse_descriptor", "descriptor", iterations, [&](unsigned)
+    {
+        hid_parse_descriptor(test_descriptor, sizeof(test_descriptor), info);
+    });
+
+    bench("usb_set_hid_descriptor", "descriptor", iterations, [](unsigned)
+    {
+        usb_set_hid_descriptor(test_descriptor, sizeof(test_descriptor));
+    });
+
+    bench("merge_add_device", "descriptor", iterations, [](unsigned)
+    {
+        merge_reset();
+        merge_add_device(0, test_descriptor, sizeof(test_descriptor));
+    });
+
+    // reports
+    for(auto policy : {ReportPolicy::DropNew, ReportPolicy::DropOld, ReportPolicy::Coalesce})
+    {
+        static const char *names[]{"usb report (DropNew)", "usb report (DropOld)", "usb report (Coalesce)"};
+
+        usb_set_report_policy(policy);
+        bench(names[int(policy)], "report", iterations, [&](unsigned i)
+        {
+            report[1] = i;
+            usb_queue_report(report, sizeof(report));
+            usb_update();
+        });
+    }
+
+    auto quirk = quirk_find(0x054C, 0x05C4);
+    uint8_t ds4_report[78]{0x11, 0xC0, 0x00, 0x80, 0x80, 0x80, 0x80, 0x08};
+    uint8_t out[USB_MAX_REPORT_SIZE];
+
+    bench("quirk_translate_report", "report", iterations, [&](unsigned i)
+    {
+        ds4_report[8] = i;
+        quirk_translate_report(&quirk->full, ds4_report, sizeof(ds4_report), out);
+    });
+
+    merge_reset();
+    merge_add_device(0, test_descriptor, sizeof(test_descriptor));
+    merge_add_device(1, test_descriptor, sizeof(test_descriptor));
+
+    bench("merged report", "report", iterations, [&](unsigned i)
+    {
+        report[1] = i;
+        merge_queue_report(i & 1, report, sizeof(report));
+        merge_update();
+        usb_update();
+    });
+
+    uint8_t sdp_event[]{SDP_EVENT_QUERY_ATTRIBUTE_VALUE, 9, 0, 0, 0x01, 0x02, 3, 0, 0, 0, 0x09};
+    uint16_t vid, pid;
+
+    bench("pnp_info_handle_sdp_event", "event", iterations, [&](unsigned i)
+    {
+        // cycle through the offsets without completing the value (which would print)
+        sdp_event[8] = i & 1;
+        pnp_info_handle_sdp_event(sdp_event, sizeof(sdp_event), vid, pid);
+    });
+
+    return 0;
+}
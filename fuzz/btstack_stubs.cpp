@@ -0,0 +1,15 @@
+#include "btstack.h"
+
+// can't include tusb.h here, both define hid_report_type_t
+
+uint8_t stub_hid_host_status = ERROR_CODE_SUCCESS;
+
+uint8_t hid_host_send_report(uint16_t hid_cid, uint8_t report_id, const uint8_t *report, uint8_t report_len)
+{
+    return stub_hid_host_status;
+}
+
+uint8_t hid_host_send_get_report(uint16_t hid_cid, hid_report_type_t report_type, uint8_t report_id)
+{
+    return stub_hid_host_status;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// reads values from the fuzzer input, returning 0s once it runs out
+struct FuzzInput
+{
+    const uint8_t *data;
+    size_t size;
+
+    uint8_t u8()
+    {
+        if(!size)
+            return 0;
+
+        size--;
+        return *data++;
+    }
+
+    uint16_t u16()
+    {
+        return u8() | u8() << 8;
+    }
+
+    // copied so that ASan catches any over-read
+    // never empty capacity, so data() isn't null for 0 length
+    std::vector<uint8_t> bytes(size_t len)
+    {
+        if(len > size)
+            len = size;
+
+        std::vector<uint8_t> ret;
+        ret.reserve(len ? len : 1);
+        ret.assign(data, data + len);
+        data += len;
+        size -= len;
+        return ret;
+    }
+};
@@ -0,0 +1,54 @@
+#include "fuzz_input.hpp"
+
+#include "hid_descriptor.hpp"
+#include "merge.hpp"
+#include "usb.hpp"
+
+// [num descriptors] then [device] [descriptor len (2)] [descriptor]...
+// then [device] [report len] [report]...
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    FuzzInput in{data, size};
+
+    merge_reset();
+
+    int num_descs = in.u8() % (MERGE_MAX_DEVICES * 2);
+
+    for(int i = 0; i < num_descs; i++)
+    {
+        // includes an out of range device
+        unsigned device = in.u8() % (MERGE_MAX_DEVICES + 1);
+        auto desc = in.bytes(in.u16() % 512);
+        merge_add_device(device, desc.data(), desc.size());
+    }
+
+    // whatever was merged should still be valid and fit the endpoint
+    uint16_t merged_len;
+    auto merged = merge_get_descriptor(merged_len);
+
+    if(merged_len)
+    {
+        HIDDescriptorInfo info;
+        if(!hid_parse_descriptor(merged, merged_len, info) || !info.has_report_ids || info.max_input_size + 1 > USB_MAX_REPORT_SIZE)
+            __builtin_trap();
+    }
+
+    while(in.size)
+    {
+        unsigned device = in.u8() % (MERGE_MAX_DEVICES + 1);
+        auto report = in.bytes(in.u8() % (USB_MAX_REPORT_SIZE * 2));
+
+        merge_queue_report(device, report.data(), report.size());
+        merge_update();
+        usb_update();
+    }
+
+    // drain
+    for(int i = 0; i < MERGE_MAX_REPORT_IDS; i++)
+    {
+        merge_update();
+        usb_update();
+    }
+
+    return 0;
+}
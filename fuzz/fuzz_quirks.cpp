@@ -0,0 +1,67 @@
+#include "btstack.h"
+
+#include "fuzz_input.hpp"
+
+#include "hid_descriptor.hpp"
+#include "quirks.hpp"
+#include "usb.hpp"
+
+static const uint16_t ids[][2]
+{
+    {0x057E, 0x2009},
+    {0x054C, 0x05C4},
+    {0x054C, 0x09CC},
+};
+
+// the translated reports have to match the descriptor and fit the endpoint
+static void check_mode(const QuirkReportMode &mode)
+{
+    HIDDescriptorInfo info;
+    if(!hid_parse_descriptor(mode.descriptor, mode.descriptor_len, info) || !info.has_report_ids)
+        __builtin_trap();
+
+    if(info.max_input_size != mode.report.out_length || mode.report.length > mode.report.out_length)
+        __builtin_trap();
+
+    if(!usb_set_hid_descriptor(mode.descriptor, mode.descriptor_len))
+        __builtin_trap();
+}
+
+// [quirk] [init status] then [report len] [report]...
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    FuzzInput in{data, size};
+
+    auto &id = ids[in.u8() % 3];
+    auto quirk = quirk_find(id[0], id[1]);
+
+    check_mode(quirk->full);
+    check_mode(quirk->basic);
+
+    // falls back to the basic report if the handshake fails
+    stub_hid_host_status = in.u8() & 1 ? ERROR_CODE_SUCCESS : ERROR_CODE_COMMAND_DISALLOWED;
+    auto mode = quirk->init(0x40) ? &quirk->full : &quirk->basic;
+
+    while(in.size)
+    {
+        auto report = in.bytes(in.u8() % 128);
+
+        // usually the report we're looking for
+        if(report.size() && (report[0] & 1))
+            report[0] = mode->report.in_report_id;
+
+        std::vector<uint8_t> out(USB_MAX_REPORT_SIZE);
+        auto len = quirk_translate_report(mode, report.data(), report.size(), out.data());
+
+        if(!len)
+            continue;
+
+        if(len != mode->report.out_length + 1)
+            __builtin_trap();
+
+        usb_queue_report(out.data(), len);
+        usb_update();
+    }
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "btstack.h"
+
+#include "fuzz_input.hpp"
+
+#include "pnp_info.hpp"
+
+// a sequence of SDP events, either raw ([0] [len] [packet]) or attribute bytes
+// ([1+] [attribute] [length] [offset] [data]) with the event header filled in
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    FuzzInput in{data, size};
+
+    uint16_t vid = 0, pid = 0;
+
+    while(in.size)
+    {
+        std::vector<uint8_t> packet;
+
+        auto type = in.u8();
+
+        if(type == 0)
+            packet = in.bytes(in.u8() % 16);
+        else if(type == 0xFF)
+            packet = {SDP_EVENT_QUERY_COMPLETE, 1, in.u8()};
+        else
+        {
+            // mostly the attributes we care about
+            uint16_t attrib_id = type & 1 ? BLUETOOTH_ATTRIBUTE_VENDOR_ID : BLUETOOTH_ATTRIBUTE_PRODUCT_ID;
+            if(type & 2)
+                attrib_id = in.u16();
+
+            uint16_t len = in.u8() % 8, off = in.u8() % 8;
+
+            packet = {
+                SDP_EVENT_QUERY_ATTRIBUTE_VALUE, 9,
+                0, 0, // record id
+                uint8_t(attrib_id), uint8_t(attrib_id >> 8),
+                uint8_t(len), uint8_t(len >> 8),
+                uint8_t(off), uint8_t(off >> 8),
+                in.u8()
+            };
+        }
+
+        pnp_info_handle_sdp_event(packet.data(), packet.size(), vid, pid);
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "fuzz_input.hpp"
+
+#include "usb.hpp"
+
+// [descriptor len (2)] [descriptor] [policy/depth] then [report len] [report]...
+// a report len with the top bit set runs usb_update instead
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    FuzzInput in{data, size};
+
+    auto desc = in.bytes(in.u16());
+    usb_set_hid_descriptor(desc.data(), desc.size());
+
+    auto config = in.u8();
+    usb_set_report_policy(ReportPolicy(config % 3));
+    usb_set_report_queue_depth((config >> 2) % (USB_REPORT_QUEUE_SIZE + 2));
+
+    while(in.size)
+    {
+        auto len = in.u8();
+
+        if(len & 0x80)
+            usb_update();
+        else
+        {
+            // allow reports larger than the endpoint
+            auto report = in.bytes(len * 2);
+            usb_queue_report(report.data(), report.size());
+        }
+    }
+
+    // drain the queue
+    for(int i = 0; i < USB_REPORT_QUEUE_SIZE; i++)
+        usb_update();
+
+    if(!usb_report_queue_empty())
+        __builtin_trap();
+
+    return 0;
+}
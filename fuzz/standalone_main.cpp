@@ -0,0 +1,62 @@
+// driver for compilers without libFuzzer
+// runs any input files given, then -runs=N (default 10000) random inputs
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int main(int argc, char *argv[])
+{
+    unsigned runs = 10000;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strncmp(argv[i], "-runs=", 6) == 0)
+        {
+            runs = atoi(argv[i] + 6);
+            continue;
+        }
+
+        auto file = fopen(argv[i], "rb");
+        if(!file)
+        {
+            fprintf(stderr, "failed to open %s\n", argv[i]);
+            return 1;
+        }
+
+        std::vector<uint8_t> data;
+        int c;
+        while((c = fgetc(file)) != EOF)
+            data.push_back(c);
+
+        fclose(file);
+
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+
+    // xorshift
+    uint32_t state = 0x12345678;
+    auto rand = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    for(unsigned i = 0; i < runs; i++)
+    {
+        std::vector<uint8_t> data(rand() % 1024);
+        for(auto &b : data)
+            b = rand();
+
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+
+    printf("%u random inputs ok\n", runs);
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// stand-in for the parts of BTstack used by the host build
+// event layouts match BTstack
+
+#include <cstdint>
+
+#define ERROR_CODE_SUCCESS             0x00
+#define ERROR_CODE_UNSPECIFIED_ERROR   0x1F
+#define ERROR_CODE_COMMAND_DISALLOWED  0x0C
+
+#define SDP_EVENT_QUERY_COMPLETE        0x91
+#define SDP_EVENT_QUERY_ATTRIBUTE_VALUE 0x94
+
+#define BLUETOOTH_ATTRIBUTE_VENDOR_ID  0x0201
+#define BLUETOOTH_ATTRIBUTE_PRODUCT_ID 0x0202
+
+typedef enum
+{
+    HID_PROTOCOL_MODE_BOOT = 0,
+    HID_PROTOCOL_MODE_REPORT,
+    HID_PROTOCOL_MODE_REPORT_WITH_FALLBACK_TO_BOOT
+} hid_protocol_mode_t;
+
+typedef enum
+{
+    HID_REPORT_TYPE_RESERVED = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+static inline uint16_t little_endian_read_16(const uint8_t *buffer, int pos)
+{
+    return buffer[pos] | buffer[pos + 1] << 8;
+}
+
+static inline uint8_t hci_event_packet_get_type(const uint8_t *event)
+{
+    return event[0];
+}
+
+static inline uint16_t sdp_event_query_attribute_byte_get_attribute_id(const uint8_t *event)
+{
+    return little_endian_read_16(event, 4);
+}
+
+static inline uint16_t sdp_event_query_attribute_byte_get_attribute_length(const uint8_t *event)
+{
+    return little_endian_read_16(event, 6);
+}
+
+static inline uint16_t sdp_event_query_attribute_byte_get_data_offset(const uint8_t *event)
+{
+    return little_endian_read_16(event, 8);
+}
+
+static inline uint8_t sdp_event_query_attribute_byte_get_data(const uint8_t *event)
+{
+    return event[10];
+}
+
+static inline uint8_t sdp_event_query_complete_get_status(const uint8_t *event)
+{
+    return event[2];
+}
+
+// return stub_hid_host_status
+uint8_t hid_host_send_report(uint16_t hid_cid, uint8_t report_id, const uint8_t *report, uint8_t report_len);
+uint8_t hid_host_send_get_report(uint16_t hid_cid, hid_report_type_t report_type, uint8_t report_id);
+
+extern uint8_t stub_hid_host_status;
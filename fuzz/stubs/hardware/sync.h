@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+static inline uint32_t save_and_disable_interrupts()
+{
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+    (void)status;
+}
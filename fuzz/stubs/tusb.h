@@ -0,0 +1,28 @@
+#pragma once
+
+// stand-in for the parts of TinyUSB used by the host build
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "tusb_option.h"
+
+typedef enum
+{
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+bool tusb_init();
+void tud_task();
+
+bool tud_connect();
+bool tud_disconnect();
+bool tud_connected();
+
+bool tud_hid_ready();
+// aborts if the report is larger than the endpoint
+bool tud_hid_report(uint8_t report_id, const void *report, uint16_t len);
@@ -0,0 +1,13 @@
+#pragma once
+
+// stand-in for TinyUSB's options, only enough for tusb_config.h
+
+#define OPT_MCU_NONE 0
+
+#define OPT_MODE_DEVICE     0x01
+#define OPT_MODE_FULL_SPEED 0x00
+#define OPT_MODE_HIGH_SPEED 0x400
+
+#define OPT_OS_NONE 1
+
+#include "tusb_config.h"
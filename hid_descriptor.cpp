@@ -0,0 +1,130 @@
+#include <cstring>
+
+#include "hid_descriptor.hpp"
+
+// item tags (including type bits)
+#define HID_ITEM_INPUT        0x80
+#define HID_ITEM_REPORT_SIZE  0x74
+#define HID_ITEM_REPORT_ID    0x84
+#define HID_ITEM_REPORT_COUNT 0x94
+#define HID_ITEM_PUSH         0xA4
+#define HID_ITEM_POP          0xB4
+#define HID_ITEM_LONG         0xFE
+
+#define MAX_PUSH_DEPTH 8
+
+struct GlobalState
+{
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+};
+
+// input bits for each report ID
+static uint32_t input_bits[256];
+
+unsigned hid_get_item_len(const uint8_t *desc, unsigned off, unsigned len)
+{
+    unsigned item_len;
+
+    if(desc[off] == HID_ITEM_LONG)
+        item_len = off + 1 < len ? 3 + desc[off + 1] : 3;
+    else
+    {
+        unsigned size = desc[off] & 3;
+        item_len = 1 + (size == 3 ? 4 : size);
+    }
+
+    return off + item_len <= len ? item_len : 0;
+}
+
+uint32_t hid_get_item_value(const uint8_t *item)
+{
+    switch(item[0] & 3)
+    {
+        case 1:
+            return item[1];
+        case 2:
+            return item[1] | item[2] << 8;
+        case 3:
+            return item[1] | item[2] << 8 | item[3] << 16 | uint32_t(item[4]) << 24;
+    }
+
+    return 0;
+}
+
+bool hid_parse_descriptor(const uint8_t *desc, uint16_t len, HIDDescriptorInfo &info)
+{
+    GlobalState state{}, stack[MAX_PUSH_DEPTH];
+    unsigned stack_depth = 0;
+
+    info.has_report_ids = false;
+    info.max_input_size = 0;
+
+    memset(input_bits, 0, sizeof(input_bits));
+
+    for(unsigned off = 0; off < len;)
+    {
+        auto item_len = hid_get_item_len(desc, off, len);
+        if(!item_len)
+            return false;
+
+        auto item = desc + off;
+        off += item_len;
+
+        if(item[0] == HID_ITEM_LONG)
+            continue;
+
+        switch(item[0] & 0xFC)
+        {
+            case HID_ITEM_INPUT:
+            {
+                uint64_t bits = uint64_t(input_bits[state.report_id]) + uint64_t(state.report_size) * state.report_count;
+                input_bits[state.report_id] = bits > UINT32_MAX ? UINT32_MAX : bits;
+                break;
+            }
+
+            case HID_ITEM_REPORT_SIZE:
+                state.report_size = hid_get_item_value(item);
+                break;
+
+            case HID_ITEM_REPORT_COUNT:
+                state.report_count = hid_get_item_value(item);
+                break;
+
+            case HID_ITEM_REPORT_ID:
+            {
+                auto id = hid_get_item_value(item);
+                if(id == 0 || id > 255)
+                    return false;
+
+                state.report_id = id;
+                info.has_report_ids = true;
+                break;
+            }
+
+            case HID_ITEM_PUSH:
+                if(stack_depth == MAX_PUSH_DEPTH)
+                    return false;
+
+                stack[stack_depth++] = state;
+                break;
+
+            case HID_ITEM_POP:
+                if(stack_depth == 0)
+                    return false;
+
+                state = stack[--stack_depth];
+                break;
+        }
+    }
+
+    for(auto bits : input_bits)
+    {
+        uint32_t size = (uint64_t(bits) + 7) / 8;
+        if(size > info.max_input_size)
+            info.max_input_size = size > UINT16_MAX ? UINT16_MAX : size;
+    }
+
+    return true;
+}
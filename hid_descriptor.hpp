@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+struct HIDDescriptorInfo
+{
+    bool has_report_ids;
+    uint16_t max_input_size; // largest input report in bytes, not including the ID
+};
+
+// returns the length of the item at off, 0 if it's truncated
+unsigned hid_get_item_len(const uint8_t *desc, unsigned off, unsigned len);
+
+// unsigned value of a short item
+uint32_t hid_get_item_value(const uint8_t *item);
+
+// returns false if the descriptor is malformed
+bool hid_parse_descriptor(const uint8_t *desc, uint16_t len, HIDDescriptorInfo &info);
@@ -6,86 +6,311 @@
 
 #include "btstack.h"
 
+#include "control.hpp"
+#include "merge.hpp"
+#include "pnp_info.hpp"
+#include "quirks.hpp"
 #include "usb.hpp"
 
 // bt
 #define INQUIRY_INTERVAL 5
 #define MAX_ATTRIBUTE_VALUE_SIZE 300
 
+// set MAX_NR_HID_HOST_CONNECTIONS > 1 in btstack_config.h to merge multiple devices into one
+#define MAX_DEVICES MAX_NR_HID_HOST_CONNECTIONS
+#define MERGE_DEVICES (MAX_DEVICES > 1)
+
+static_assert(MAX_DEVICES <= MERGE_MAX_DEVICES);
+
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
-static uint8_t hid_descriptor_storage[MAX_ATTRIBUTE_VALUE_SIZE];
+static uint8_t hid_descriptor_storage[MAX_ATTRIBUTE_VALUE_SIZE * MAX_DEVICES];
+
+// the control interface validates against this without including btstack
+static_assert(HID_PROTOCOL_MODE_REPORT_WITH_FALLBACK_TO_BOOT == 2);
 
 // TODO: only HID_PROTOCOL_MODE_REPORT works on Switch Pro Controller (bug?)
-static hid_protocol_mode_t hid_host_report_mode = HID_PROTOCOL_MODE_REPORT;//_WITH_FALLBACK_TO_BOOT;
-static uint16_t hid_host_cid = 0;
+static BTConfig bt_config{INQUIRY_INTERVAL, HID_PROTOCOL_MODE_REPORT/*_WITH_FALLBACK_TO_BOOT*/};
 
 enum class ConnectionState
 {
     Scan,
     StartConnection,
     Connecting,
-    Connected
+    Connected // all device slots in use
 };
 
 static ConnectionState state = ConnectionState::Scan;
 
+struct Device
+{
+    bool active; // connecting or connected
+    bool connected;
+    bool used; // has been connected before
+
+    bd_addr_t addr;
+    uint16_t hid_cid;
+
+    // device info, both needed before the usb side is set up
+    bool have_pnp_info;
+    bool have_descriptor;
+    uint16_t vid, pid;
+
+    const QuirkReportMode *quirk_mode; // null if passed through as-is
+};
+
+static Device devices[MAX_DEVICES];
+
 static bd_addr_t connect_addr;
 static bool have_addr = false;
 
+// connect to the same device again after disconnecting
+static bool reconnect_on_close = false;
+static Device *last_device = nullptr;
+
+// only one SDP query can run at a time
+static Device *sdp_device = nullptr;
+static bool sdp_device_closed = false; // disconnected during the query, ignore the results
+
+// devices with a descriptor we can't use, not connected to again
+#define MAX_UNUSABLE_ADDRS 4
+static bd_addr_t unusable_addrs[MAX_UNUSABLE_ADDRS];
+static unsigned num_unusable_addrs = 0;
+
+static bool usb_ready = false;
+
 static void start_scan()
 {
     state = ConnectionState::Scan;
     have_addr = false;
-    gap_inquiry_start(INQUIRY_INTERVAL);
+    gap_inquiry_start(bt_config.inquiry_interval);
 }
 
-static uint8_t attribute_value[4];
+static Device *find_device(uint16_t hid_cid)
+{
+    for(auto &dev : devices)
+    {
+        if(dev.active && dev.hid_cid == hid_cid)
+            return &dev;
+    }
 
-static void handle_sdp_client_query_result(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size)
+    return nullptr;
+}
+
+static Device *find_device(const bd_addr_t addr)
 {
-    switch(hci_event_packet_get_type(packet))
+    for(auto &dev : devices)
     {
-        case SDP_EVENT_QUERY_ATTRIBUTE_VALUE:
-        {
-            auto off = sdp_event_query_attribute_byte_get_data_offset(packet);
-            auto len = sdp_event_query_attribute_byte_get_attribute_length(packet);
+        if(dev.active && bd_addr_cmp(dev.addr, addr) == 0)
+            return &dev;
+    }
 
-            if(len <= sizeof(attribute_value))
-            {
-                attribute_value[off] = sdp_event_query_attribute_byte_get_data(packet);
-                if(off + 1 == len)
-                {
-                    // check for VID/PIT attribs
-                    auto attrib_id = sdp_event_query_attribute_byte_get_attribute_id(packet);
-                    if(attribute_value[0] == 0x09/*16-bit UINT*/ && attrib_id == BLUETOOTH_ATTRIBUTE_VENDOR_ID)
-                    {
-                        auto vid = attribute_value[1] << 8 | attribute_value[2];
-                        printf("vid %04X\n", vid);
-                    }
-                    else if(attribute_value[0] == 0x09/*16-bit UINT*/ && attrib_id == BLUETOOTH_ATTRIBUTE_PRODUCT_ID)
-                    {
-                        auto pid = attribute_value[1] << 8 | attribute_value[2];
-                        printf("pid %04X\n", pid);
-                    }
-                }
-            }
+    return nullptr;
+}
+
+static Device *alloc_device(const bd_addr_t addr)
+{
+    Device *ret = nullptr;
 
+    // prefer the slot this device used before, then an unused one
+    // (merged report IDs are assigned per slot)
+    for(auto &dev : devices)
+    {
+        // can't reuse the slot until the query for the previous device is done
+        if(dev.active || &dev == sdp_device)
+            continue;
+
+        if(dev.used && bd_addr_cmp(dev.addr, addr) == 0)
+        {
+            ret = &dev;
             break;
         }
 
-        case SDP_EVENT_QUERY_COMPLETE:
+        if(!ret || (ret->used && !dev.used))
+            ret = &dev;
+    }
+
+    if(ret)
+    {
+        bool used = ret->used;
+        *ret = {};
+        ret->active = true;
+        ret->used = used;
+        memcpy(ret->addr, addr, sizeof(bd_addr_t));
+    }
+
+    return ret;
+}
+
+static bool is_unusable_addr(const bd_addr_t addr)
+{
+    for(unsigned i = 0; i < num_unusable_addrs && i < MAX_UNUSABLE_ADDRS; i++)
+    {
+        if(bd_addr_cmp(unusable_addrs[i], addr) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// disconnects without rescanning/reconnecting to the same device
+static void drop_unusable_device(Device &dev)
+{
+    // replaces the oldest if full
+    memcpy(unusable_addrs[num_unusable_addrs % MAX_UNUSABLE_ADDRS], dev.addr, sizeof(bd_addr_t));
+    num_unusable_addrs++;
+
+    if(&dev == last_device)
+        reconnect_on_close = false;
+
+    hid_host_disconnect(dev.hid_cid);
+}
+
+static bool have_free_device()
+{
+    for(auto &dev : devices)
+    {
+        if(!dev.active && &dev != sdp_device)
+            return true;
+    }
+
+    return false;
+}
+
+static void get_device_descriptor(const Device &dev, const uint8_t *&desc, uint16_t &desc_len)
+{
+    if(dev.quirk_mode)
+    {
+        desc = dev.quirk_mode->descriptor;
+        desc_len = dev.quirk_mode->descriptor_len;
+    }
+    else
+    {
+        desc = hid_descriptor_storage_get_descriptor_data(dev.hid_cid);
+        desc_len = hid_descriptor_storage_get_descriptor_len(dev.hid_cid);
+    }
+}
+
+static void finish_device_setup(Device &dev)
+{
+    if(!dev.connected || !dev.have_pnp_info || !dev.have_descriptor)
+        return;
+
+    auto quirk = quirk_find(dev.vid, dev.pid);
+
+    if(quirk)
+    {
+        printf("using quirks for %s\n", quirk->name);
+
+        // without the handshake the device keeps sending its basic report, forward that instead
+        // (the device's own descriptor has reports that don't fit the endpoint)
+        if(quirk->init(dev.hid_cid))
+            dev.quirk_mode = &quirk->full;
+        else
         {
-            auto status = sdp_event_query_complete_get_status(packet);
-            if(status)
-                printf("SDP query failed %02x\n", status);
-            else
-                printf("SDP query done.\n");
-            break;
+            printf("quirk init failed, using basic reports\n");
+            dev.quirk_mode = &quirk->basic;
         }
+    }
 
-        default:
-            break;
+    const uint8_t *desc;
+    uint16_t desc_len;
+    get_device_descriptor(dev, desc, desc_len);
+
+#if MERGE_DEVICES
+    int index = &dev - devices;
+
+    if(!merge_add_device(index, desc, desc_len))
+    {
+        // can't use it, drop the connection
+        printf("failed to merge descriptor for device %i\n", index);
+        drop_unusable_device(dev);
+        return;
+    }
+
+    // wait for all the devices
+    // the usb descriptor can't change after this
+    if(usb_ready)
+        return;
+
+    for(int i = 0; i < MAX_DEVICES; i++)
+    {
+        if(!merge_has_device(i))
+            return;
+    }
+
+    desc = merge_get_descriptor(desc_len);
+    printf("merged descriptor len %i\n", desc_len);
+#endif
+
+    // broken descriptor or reports that wouldn't fit the endpoint, drop the connection
+    if(!desc || !desc_len || !usb_set_hid_descriptor(desc, desc_len))
+    {
+        printf("unusable descriptor!\n");
+        drop_unusable_device(dev);
+        return;
+    }
+
+    // should be ready now
+    usb_set_connected(true);
+    usb_ready = true;
+}
+
+static void query_next_pnp_info();
+
+static void handle_sdp_client_query_result(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size)
+{
+    // ignore anything from a query we aren't tracking
+    if(!sdp_device)
+        return;
+
+    if(sdp_device_closed)
+    {
+        uint16_t vid, pid;
+        if(!pnp_info_handle_sdp_event(packet, size, vid, pid))
+            return;
+
+        // the slot can be used again
+        sdp_device = nullptr;
+        sdp_device_closed = false;
+
+        if(state == ConnectionState::Connected && have_free_device())
+            start_scan();
+
+        query_next_pnp_info();
+        return;
+    }
+
+    if(!pnp_info_handle_sdp_event(packet, size, sdp_device->vid, sdp_device->pid))
+        return;
+
+    // continue without quirks if this failed
+    sdp_device->have_pnp_info = true;
+    finish_device_setup(*sdp_device);
+
+    sdp_device = nullptr;
+    query_next_pnp_info();
+}
+
+static void query_next_pnp_info()
+{
+    if(sdp_device)
+        return;
+
+    for(auto &dev : devices)
+    {
+        if(dev.connected && !dev.have_pnp_info)
+        {
+            sdp_device = &dev;
+            if(sdp_client_query_uuid16(&handle_sdp_client_query_result, dev.addr, BLUETOOTH_SERVICE_CLASS_PNP_INFORMATION) == ERROR_CODE_SUCCESS)
+                return;
+
+            // continue without quirks
+            printf("SDP query failed to start\n");
+            sdp_device = nullptr;
+            dev.have_pnp_info = true;
+            finish_device_setup(dev);
+        }
     }
 }
 
@@ -122,7 +347,8 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
 
                 printf("Found %s CoD %06X name %s\n", bd_addr_to_str(addr), cod, name ? name : "??");
 
-                if(!have_addr)
+                // skip devices that are already connected or can't be used
+                if(!have_addr && !find_device(addr) && !is_unusable_addr(addr))
                 {
                     // try to connect to everything
                     // TODO: probably not the best idea
@@ -140,9 +366,20 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
             case GAP_EVENT_INQUIRY_COMPLETE:
                 printf("inquiry complete\n");
 
+                if(state != ConnectionState::Scan)
+                    break;
+
+                // stopped early if all the slots were filled (or waiting for a query on a closed device)
+                if(!have_free_device())
+                {
+                    have_addr = false;
+                    state = ConnectionState::Connected;
+                    break;
+                }
+
                 if(have_addr)
                     state = ConnectionState::StartConnection;
-                else if(state == ConnectionState::Scan)
+                else
                     start_scan(); // scan again
                 break;
 
@@ -158,22 +395,48 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
 
                         printf("incoming conn from%s\n", bd_addr_to_str(addr));
 
-                        hid_host_accept_connection(hid_subevent_incoming_connection_get_hid_cid(packet), hid_host_report_mode);
-                       
+                        auto hid_cid = hid_subevent_incoming_connection_get_hid_cid(packet);
+                        auto dev = is_unusable_addr(addr) ? nullptr : alloc_device(addr);
+
+                        if(dev)
+                        {
+                            dev->hid_cid = hid_cid;
+                            hid_host_accept_connection(hid_cid, hid_protocol_mode_t(bt_config.report_mode));
+                        }
+                        else
+                            hid_host_decline_connection(hid_cid);
+
                         break;
                     }
 
                     case HID_SUBEVENT_CONNECTION_OPENED:
                     {
                         auto status = hid_subevent_connection_opened_get_status(packet);
+                        auto dev = find_device(hid_subevent_connection_opened_get_hid_cid(packet));
+
+                        if(!dev)
+                            break;
 
                         if(status == ERROR_CODE_SUCCESS)
                         {
                             printf("connected\n");
-                            state = ConnectionState::Connected;
+                            dev->connected = dev->used = true;
+                            last_device = dev;
+
+                            // keep scanning if there's room for more devices
+                            if(!have_free_device())
+                            {
+                                if(state == ConnectionState::Scan)
+                                    gap_inquiry_stop();
+
+                                have_addr = false;
+                                state = ConnectionState::Connected;
+                            }
+                            else if(state == ConnectionState::Connecting)
+                                start_scan();
 
                             // get vid/pid
-                            sdp_client_query_uuid16(&handle_sdp_client_query_result, connect_addr, BLUETOOTH_SERVICE_CLASS_PNP_INFORMATION);
+                            query_next_pnp_info();
                         }
                         else
                         {
@@ -182,12 +445,16 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                             if(status == L2CAP_CONNECTION_RESPONSE_RESULT_REFUSED_SECURITY)
                             {
                                 printf("drop key?\n");
-                                gap_drop_link_key_for_bd_addr(connect_addr);
+                                gap_drop_link_key_for_bd_addr(dev->addr);
                             }
 
+                            dev->active = false;
+
                             // TODO: try different device?
                             printf("Connection failed: %x\n", status);
-                            start_scan();
+
+                            if(state != ConnectionState::Scan)
+                                start_scan();
                         }
 
                         break;
@@ -196,15 +463,14 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                     case HID_SUBEVENT_DESCRIPTOR_AVAILABLE:
                     {
                         auto status = hid_subevent_descriptor_available_get_status(packet);
-                        if(status == ERROR_CODE_SUCCESS) {
-                            auto desc_len = hid_descriptor_storage_get_descriptor_len(hid_host_cid);
-                            auto desc = hid_descriptor_storage_get_descriptor_data(hid_host_cid);
-                            printf("got descriptor len %i\n", desc_len);
+                        auto dev = find_device(hid_subevent_descriptor_available_get_hid_cid(packet));
 
-                            usb_set_hid_descriptor(desc, desc_len);
+                        if(dev && status == ERROR_CODE_SUCCESS) {
+                            auto desc_len = hid_descriptor_storage_get_descriptor_len(dev->hid_cid);
+                            printf("got descriptor len %i\n", desc_len);
 
-                            // should be ready now
-                            usb_set_connected(true);
+                            dev->have_descriptor = true;
+                            finish_device_setup(*dev);
                         }
                         break;
                     }
@@ -213,12 +479,33 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                     {
                         auto report = hid_subevent_report_get_report(packet);
                         auto len = hid_subevent_report_get_report_len(packet);
+                        auto dev = find_device(hid_subevent_report_get_hid_cid(packet));
 
-                        printf("got report len %i\n", len);
+                        // need at least the extra byte
+                        if(!dev || len < 1)
+                            break;
 
-                        // forward report
                         // there's an extra byte?
-                        usb_queue_report(report + 1, len - 1);
+                        const uint8_t *data = report + 1;
+                        uint16_t data_len = len - 1;
+
+                        uint8_t translated[USB_MAX_REPORT_SIZE];
+
+                        if(dev->quirk_mode)
+                        {
+                            data_len = quirk_translate_report(dev->quirk_mode, data, data_len, translated);
+                            data = translated;
+
+                            if(!data_len)
+                                break;
+                        }
+
+                        // forward report
+#if MERGE_DEVICES
+                        merge_queue_report(dev - devices, data, data_len);
+#else
+                        usb_queue_report(data, data_len);
+#endif
                         break;
                     }
 
@@ -226,7 +513,23 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                     {
                         printf("disconnected\n");
 
-                        start_scan();
+                        auto dev = find_device(hid_subevent_connection_closed_get_hid_cid(packet));
+
+                        if(dev)
+                            dev->active = dev->connected = false;
+
+                        // the rest of the query would be for the old device
+                        if(dev && dev == sdp_device)
+                            sdp_device_closed = true;
+
+                        if(dev && reconnect_on_close && dev == last_device)
+                        {
+                            reconnect_on_close = false;
+                            memcpy(connect_addr, dev->addr, sizeof(bd_addr_t));
+                            state = ConnectionState::StartConnection;
+                        }
+                        else if(state == ConnectionState::Connected)
+                            start_scan();
                         break;
                     }
                 }
@@ -239,6 +542,83 @@ static void bt_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
     }
 }
 
+static bool do_control_action(ControlAction action)
+{
+    // can't disconnect until the connection has opened (or failed)
+    for(auto &dev : devices)
+    {
+        if(dev.active && !dev.connected)
+            return false;
+    }
+
+    switch(action)
+    {
+        case ControlAction::Rescan:
+            printf("rescan requested\n");
+
+            // scan restarts when closed
+            reconnect_on_close = false;
+
+            for(auto &dev : devices)
+            {
+                if(dev.active)
+                    hid_host_disconnect(dev.hid_cid);
+            }
+
+            if(state == ConnectionState::StartConnection)
+                start_scan();
+            else if(state == ConnectionState::Scan)
+            {
+                // restarts from the inquiry complete event, with the new interval
+                have_addr = false;
+                gap_inquiry_stop();
+            }
+            return true;
+
+        case ControlAction::Reconnect:
+            printf("reconnect requested\n");
+
+            // most recently connected device
+            if(last_device && last_device->active)
+            {
+                reconnect_on_close = true;
+                hid_host_disconnect(last_device->hid_cid);
+                return true;
+            }
+
+            if(last_device)
+            {
+                if(is_unusable_addr(last_device->addr))
+                    return false;
+
+                // also stops any inquiry result replacing it
+                memcpy(connect_addr, last_device->addr, sizeof(bd_addr_t));
+                have_addr = true;
+            }
+            else if(!have_addr)
+                return false;
+
+            // can't connect during an inquiry, connects from the inquiry complete event
+            if(state == ConnectionState::Scan)
+                gap_inquiry_stop();
+            else
+                state = ConnectionState::StartConnection;
+
+            return true;
+    }
+
+    return false;
+}
+
+// called from control_update
+static bool handle_control_action(ControlAction action)
+{
+    async_context_acquire_lock_blocking(cyw43_arch_async_context());
+    bool ret = do_control_action(action);
+    async_context_release_lock(cyw43_arch_async_context());
+
+    return ret;
+}
 
 int main()
 {
@@ -275,9 +655,10 @@ int main()
 
     // turn on!
     hci_power_control(HCI_POWER_ON);
-        
+
     // usb init
     usb_init();
+    control_init(&bt_config, handle_control_action);
 
     while(true)
     {
@@ -286,15 +667,39 @@ int main()
             // lock context
             async_context_acquire_lock_blocking(cyw43_arch_async_context());
 
-            printf("connecting to %s...\n", bd_addr_to_str(connect_addr));
-            hid_host_connect(connect_addr, hid_host_report_mode, &hid_host_cid);
-            state = ConnectionState::Connecting;
+            auto dev = alloc_device(connect_addr);
+
+            if(!dev)
+            {
+                // all slots in use, wait for a disconnect
+                have_addr = false;
+                state = ConnectionState::Connected;
+            }
+            else
+            {
+                printf("connecting to %s...\n", bd_addr_to_str(connect_addr));
+
+                if(hid_host_connect(connect_addr, hid_protocol_mode_t(bt_config.report_mode), &dev->hid_cid) == ERROR_CODE_SUCCESS)
+                    state = ConnectionState::Connecting;
+                else
+                {
+                    dev->active = false;
+                    start_scan();
+                }
+            }
 
             async_context_release_lock(cyw43_arch_async_context());
         }
 
+#if MERGE_DEVICES
+        merge_update();
+#endif
+
         usb_update();
 
+        // low priority, after any report has been sent
+        control_update();
+
         sleep_ms(1);
     }
 
@@ -0,0 +1,266 @@
+#include <cstring>
+
+#include "hardware/sync.h"
+
+#include "hid_descriptor.hpp"
+#include "merge.hpp"
+#include "usb.hpp"
+
+struct MergedDevice
+{
+    bool added;
+    bool enabled; // false if a different device is using the slot
+    bool has_report_ids;
+
+    uint16_t desc_len;
+    uint32_t desc_hash;
+};
+
+// merged ID is index + 1
+struct ReportIDMapping
+{
+    uint8_t device;
+    uint8_t report_id; // 0 if the device doesn't use IDs
+};
+
+// latest report for each merged ID
+struct ReportSlot
+{
+    uint8_t data[USB_MAX_REPORT_SIZE];
+    uint16_t len;
+    bool pending;
+};
+
+static MergedDevice devices[MERGE_MAX_DEVICES];
+
+static ReportIDMapping id_mappings[MERGE_MAX_REPORT_IDS];
+static unsigned num_ids = 0;
+
+static ReportSlot report_slots[MERGE_MAX_REPORT_IDS];
+static unsigned next_slot = 0;
+
+static uint8_t merged_descriptor[MERGE_MAX_DESCRIPTOR_SIZE];
+static uint16_t merged_descriptor_len = 0;
+
+static int find_id(unsigned device, uint8_t report_id)
+{
+    for(unsigned i = 0; i < num_ids; i++)
+    {
+        if(id_mappings[i].device == device && id_mappings[i].report_id == report_id)
+            return i + 1;
+    }
+
+    return 0;
+}
+
+static int add_id(unsigned device, uint8_t report_id)
+{
+    auto id = find_id(device, report_id);
+    if(id)
+        return id;
+
+    if(num_ids == MERGE_MAX_REPORT_IDS)
+        return 0;
+
+    id_mappings[num_ids] = {uint8_t(device), report_id};
+    return ++num_ids;
+}
+
+// FNV-1a, to spot a different device reusing a slot
+static uint32_t hash_descriptor(const uint8_t *desc, uint16_t len)
+{
+    uint32_t hash = 2166136261;
+
+    for(unsigned i = 0; i < len; i++)
+        hash = (hash ^ desc[i]) * 16777619;
+
+    return hash;
+}
+
+bool merge_add_device(unsigned device, const uint8_t *desc, uint16_t len)
+{
+    if(device >= MERGE_MAX_DEVICES)
+        return false;
+
+    auto &merged_dev = devices[device];
+
+    // keep the IDs if it's the same descriptor, otherwise the reports would be misinterpreted
+    if(merged_dev.added)
+    {
+        merged_dev.enabled = len == merged_dev.desc_len && hash_descriptor(desc, len) == merged_dev.desc_hash;
+        return merged_dev.enabled;
+    }
+
+    HIDDescriptorInfo info;
+    if(!hid_parse_descriptor(desc, len, info))
+        return false;
+
+    // every report gets an ID, which needs to fit in the endpoint
+    if(info.max_input_size + 1 > USB_MAX_REPORT_SIZE)
+        return false;
+
+    auto has_report_ids = info.has_report_ids;
+
+    // copy the descriptor, remapping IDs
+    // wrapped in push/pop so global items don't leak between devices
+    auto old_num_ids = num_ids;
+    auto out = merged_descriptor + merged_descriptor_len;
+    auto out_end = merged_descriptor + sizeof(merged_descriptor);
+
+    // push + report ID + pop
+    if(out + len + 4 > out_end)
+        return false;
+
+    *out++ = 0xA4; // Push
+
+    if(!has_report_ids)
+    {
+        auto id = add_id(device, 0);
+        if(!id)
+            return false;
+
+        *out++ = 0x85;
+        *out++ = id;
+    }
+
+    for(unsigned off = 0; off < len;)
+    {
+        // already validated by hid_parse_descriptor
+        auto item_len = hid_get_item_len(desc, off, len);
+
+        if((desc[off] & 0xFC) == 0x84) // Report ID, any size
+        {
+            auto id = add_id(device, hid_get_item_value(desc + off));
+            if(!id)
+            {
+                num_ids = old_num_ids;
+                return false;
+            }
+
+            *out++ = 0x85;
+            *out++ = id;
+        }
+        else
+        {
+            memcpy(out, desc + off, item_len);
+            out += item_len;
+        }
+
+        off += item_len;
+    }
+
+    *out++ = 0xB4; // Pop
+
+    // unbalanced push/pops or inputs before the first ID can pick up state from the previous device
+    // so check the result still parses and fits
+    uint16_t new_len = out - merged_descriptor;
+    if(!hid_parse_descriptor(merged_descriptor, new_len, info) || info.max_input_size + 1 > USB_MAX_REPORT_SIZE)
+    {
+        num_ids = old_num_ids;
+        return false;
+    }
+
+    merged_descriptor_len = new_len;
+
+    merged_dev.added = merged_dev.enabled = true;
+    merged_dev.has_report_ids = has_report_ids;
+    merged_dev.desc_len = len;
+    merged_dev.desc_hash = hash_descriptor(desc, len);
+
+    return true;
+}
+
+void merge_reset()
+{
+    auto irq_state = save_and_disable_interrupts();
+
+    for(auto &dev : devices)
+        dev = {};
+
+    for(auto &slot : report_slots)
+        slot.pending = false;
+
+    num_ids = 0;
+    next_slot = 0;
+    merged_descriptor_len = 0;
+
+    restore_interrupts(irq_state);
+}
+
+bool merge_has_device(unsigned device)
+{
+    return device < MERGE_MAX_DEVICES && devices[device].added;
+}
+
+const uint8_t *merge_get_descriptor(uint16_t &len)
+{
+    len = merged_descriptor_len;
+    return merged_descriptor;
+}
+
+void merge_queue_report(unsigned device, const uint8_t *data, uint16_t len)
+{
+    if(!merge_has_device(device) || !devices[device].enabled)
+        return;
+
+    uint8_t report_id = 0;
+
+    if(devices[device].has_report_ids)
+    {
+        if(!len)
+            return;
+
+        report_id = *data++;
+        len--;
+    }
+
+    auto id = find_id(device, report_id);
+
+    if(!id || len + 1 > USB_MAX_REPORT_SIZE)
+        return;
+
+    auto &slot = report_slots[id - 1];
+
+    // replacing a report that hasn't been sent yet
+    if(slot.pending)
+        usb_count_coalesced_report();
+
+    auto irq_state = save_and_disable_interrupts();
+
+    slot.data[0] = id;
+    memcpy(slot.data + 1, data, len);
+    slot.len = len + 1;
+    slot.pending = true;
+
+    restore_interrupts(irq_state);
+}
+
+void merge_update()
+{
+    if(!usb_report_queue_empty())
+        return;
+
+    // start after the last sent ID so that one device can't starve the others
+    for(unsigned i = 0; i < num_ids; i++)
+    {
+        auto index = (next_slot + i) % num_ids;
+        auto &slot = report_slots[index];
+
+        if(!slot.pending)
+            continue;
+
+        uint8_t data[USB_MAX_REPORT_SIZE];
+        uint16_t len;
+
+        auto irq_state = save_and_disable_interrupts();
+        memcpy(data, slot.data, slot.len);
+        len = slot.len;
+        slot.pending = false;
+        restore_interrupts(irq_state);
+
+        usb_queue_report(data, len);
+
+        next_slot = index + 1;
+        break;
+    }
+}
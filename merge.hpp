@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// combines multiple devices into one report descriptor, remapping report IDs
+#define MERGE_MAX_DEVICES 4
+#define MERGE_MAX_REPORT_IDS 16
+#define MERGE_MAX_DESCRIPTOR_SIZE 1024
+
+// adds a device's descriptor to the merged one
+// returns false if it can't be merged (malformed, reports too large for the endpoint or out of space/IDs)
+// if the device has already been added the IDs are kept, but the descriptor has to match
+// or the device's reports are ignored
+bool merge_add_device(unsigned device, const uint8_t *desc, uint16_t len);
+bool merge_has_device(unsigned device);
+
+// forgets all devices and IDs
+void merge_reset();
+
+const uint8_t *merge_get_descriptor(uint16_t &len);
+
+// stores the latest report for the remapped ID
+void merge_queue_report(unsigned device, const uint8_t *data, uint16_t len);
+
+// forwards one pending report, cycling through the IDs
+void merge_update();
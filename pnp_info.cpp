@@ -0,0 +1,69 @@
+#include <cstdio>
+
+#include "btstack.h"
+
+#include "pnp_info.hpp"
+
+// event, len, record id, attribute id, attribute length, offset, data
+#define ATTRIBUTE_VALUE_EVENT_SIZE 11
+// event, len, status
+#define QUERY_COMPLETE_EVENT_SIZE 3
+
+static uint8_t attribute_value[4];
+
+bool pnp_info_handle_sdp_event(const uint8_t *packet, uint16_t size, uint16_t &vid, uint16_t &pid)
+{
+    if(size < 1)
+        return false;
+
+    switch(hci_event_packet_get_type(packet))
+    {
+        case SDP_EVENT_QUERY_ATTRIBUTE_VALUE:
+        {
+            if(size < ATTRIBUTE_VALUE_EVENT_SIZE)
+                break;
+
+            auto off = sdp_event_query_attribute_byte_get_data_offset(packet);
+            auto len = sdp_event_query_attribute_byte_get_attribute_length(packet);
+
+            // ignore anything that doesn't fit
+            if(off >= len || len > sizeof(attribute_value))
+                break;
+
+            attribute_value[off] = sdp_event_query_attribute_byte_get_data(packet);
+            if(off + 1 == len)
+            {
+                // check for VID/PIT attribs
+                auto attrib_id = sdp_event_query_attribute_byte_get_attribute_id(packet);
+                if(len == 3 && attribute_value[0] == 0x09/*16-bit UINT*/ && attrib_id == BLUETOOTH_ATTRIBUTE_VENDOR_ID)
+                {
+                    vid = attribute_value[1] << 8 | attribute_value[2];
+                    printf("vid %04X\n", vid);
+                }
+                else if(len == 3 && attribute_value[0] == 0x09/*16-bit UINT*/ && attrib_id == BLUETOOTH_ATTRIBUTE_PRODUCT_ID)
+                {
+                    pid = attribute_value[1] << 8 | attribute_value[2];
+                    printf("pid %04X\n", pid);
+                }
+            }
+
+            break;
+        }
+
+        case SDP_EVENT_QUERY_COMPLETE:
+        {
+            auto status = size < QUERY_COMPLETE_EVENT_SIZE ? ERROR_CODE_UNSPECIFIED_ERROR : sdp_event_query_complete_get_status(packet);
+            if(status)
+                printf("SDP query failed %02x\n", status);
+            else
+                printf("SDP query done.\n");
+
+            return true;
+        }
+
+        default:
+            break;
+    }
+
+    return false;
+}
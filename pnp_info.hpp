@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// handles an SDP client event from a PnP information query, filling in the vid/pid
+// returns true once the query has completed (successfully or not)
+bool pnp_info_handle_sdp_event(const uint8_t *packet, uint16_t size, uint16_t &vid, uint16_t &pid);
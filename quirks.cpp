@@ -0,0 +1,254 @@
+#include <cstdio>
+#include <cstring>
+
+#include "btstack.h"
+
+#include "quirks.hpp"
+
+// Switch Pro Controller
+// sends the slow 0x3F report until switched to the full 0x30 report
+static const uint8_t switch_pro_descriptor[]
+{
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x05,       // Usage (Game Pad)
+    0xA1, 0x01,       // Collection (Application)
+    0x85, 0x01,       //   Report ID (1)
+
+    // timer, battery/connection info
+    0x06, 0x00, 0xFF, //   Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x20,       //   Usage (0x20)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x26, 0xFF, 0x00, //   Logical Maximum (255)
+    0x75, 0x08,       //   Report Size (8)
+    0x95, 0x02,       //   Report Count (2)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // right, shared, left button bytes
+    0x05, 0x09,       //   Usage Page (Button)
+    0x19, 0x01,       //   Usage Minimum (1)
+    0x29, 0x18,       //   Usage Maximum (24)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x25, 0x01,       //   Logical Maximum (1)
+    0x75, 0x01,       //   Report Size (1)
+    0x95, 0x18,       //   Report Count (24)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // 12-bit sticks
+    0x05, 0x01,       //   Usage Page (Generic Desktop)
+    0x09, 0x30,       //   Usage (X)
+    0x09, 0x31,       //   Usage (Y)
+    0x09, 0x33,       //   Usage (Rx)
+    0x09, 0x34,       //   Usage (Ry)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x26, 0xFF, 0x0F, //   Logical Maximum (4095)
+    0x75, 0x0C,       //   Report Size (12)
+    0x95, 0x04,       //   Report Count (4)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // vibrator input report
+    0x06, 0x00, 0xFF, //   Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x21,       //   Usage (0x21)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x26, 0xFF, 0x00, //   Logical Maximum (255)
+    0x75, 0x08,       //   Report Size (8)
+    0x95, 0x01,       //   Report Count (1)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // 3 IMU samples of accel x/y/z, gyro x/y/z
+    0x09, 0x22,       //   Usage (0x22)
+    0x16, 0x00, 0x80, //   Logical Minimum (-32768)
+    0x26, 0xFF, 0x7F, //   Logical Maximum (32767)
+    0x75, 0x10,       //   Report Size (16)
+    0x95, 0x12,       //   Report Count (18)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    0xC0              // End Collection
+};
+
+// the 0x3F report, if the handshake fails
+static const uint8_t switch_pro_basic_descriptor[]
+{
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x05,       // Usage (Game Pad)
+    0xA1, 0x01,       // Collection (Application)
+    0x85, 0x01,       //   Report ID (1)
+
+    // buttons
+    0x05, 0x09,       //   Usage Page (Button)
+    0x19, 0x01,       //   Usage Minimum (1)
+    0x29, 0x10,       //   Usage Maximum (16)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x25, 0x01,       //   Logical Maximum (1)
+    0x75, 0x01,       //   Report Size (1)
+    0x95, 0x10,       //   Report Count (16)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // d-pad
+    0x05, 0x01,       //   Usage Page (Generic Desktop)
+    0x09, 0x39,       //   Usage (Hat switch)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x25, 0x07,       //   Logical Maximum (7)
+    0x75, 0x04,       //   Report Size (4)
+    0x95, 0x01,       //   Report Count (1)
+    0x81, 0x42,       //   Input (Data, Var, Abs, Null State)
+    0x81, 0x03,       //   Input (Const, Var, Abs)
+
+    // 16-bit sticks
+    0x09, 0x30,       //   Usage (X)
+    0x09, 0x31,       //   Usage (Y)
+    0x09, 0x33,       //   Usage (Rx)
+    0x09, 0x34,       //   Usage (Ry)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x27, 0xFF, 0xFF, 0x00, 0x00, // Logical Maximum (65535)
+    0x75, 0x10,       //   Report Size (16)
+    0x95, 0x04,       //   Report Count (4)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    0xC0              // End Collection
+};
+
+static bool switch_pro_init(uint16_t hid_cid)
+{
+    static uint8_t packet_num = 0;
+
+    // rumble + subcommand report
+    // neutral rumble data, subcommand 0x03 (set input report mode), 0x30 (full report)
+    const uint8_t report[]{
+        uint8_t(packet_num++ & 0xF),
+        0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40,
+        0x03, 0x30
+    };
+
+    auto status = hid_host_send_report(hid_cid, 0x01, report, sizeof(report));
+    if(status != ERROR_CODE_SUCCESS)
+    {
+        printf("failed to set report mode %02x\n", status);
+        return false;
+    }
+
+    return true;
+}
+
+// DualShock 4
+// only sends the extended 0x11 report after feature report 0x02 is read
+// translated to the same layout as report 0x01 over USB
+static const uint8_t ds4_descriptor[]
+{
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x05,       // Usage (Game Pad)
+    0xA1, 0x01,       // Collection (Application)
+    0x85, 0x01,       //   Report ID (1)
+
+    // sticks
+    0x09, 0x30,       //   Usage (X)
+    0x09, 0x31,       //   Usage (Y)
+    0x09, 0x32,       //   Usage (Z)
+    0x09, 0x35,       //   Usage (Rz)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x26, 0xFF, 0x00, //   Logical Maximum (255)
+    0x75, 0x08,       //   Report Size (8)
+    0x95, 0x04,       //   Report Count (4)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // d-pad
+    0x09, 0x39,       //   Usage (Hat switch)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x25, 0x07,       //   Logical Maximum (7)
+    0x35, 0x00,       //   Physical Minimum (0)
+    0x46, 0x3B, 0x01, //   Physical Maximum (315)
+    0x65, 0x14,       //   Unit (Degrees)
+    0x75, 0x04,       //   Report Size (4)
+    0x95, 0x01,       //   Report Count (1)
+    0x81, 0x42,       //   Input (Data, Var, Abs, Null State)
+    0x45, 0x00,       //   Physical Maximum (0)
+    0x65, 0x00,       //   Unit (None)
+
+    // buttons
+    0x05, 0x09,       //   Usage Page (Button)
+    0x19, 0x01,       //   Usage Minimum (1)
+    0x29, 0x0E,       //   Usage Maximum (14)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x25, 0x01,       //   Logical Maximum (1)
+    0x75, 0x01,       //   Report Size (1)
+    0x95, 0x0E,       //   Report Count (14)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // report counter
+    0x75, 0x06,       //   Report Size (6)
+    0x95, 0x01,       //   Report Count (1)
+    0x81, 0x03,       //   Input (Const, Var, Abs)
+
+    // triggers
+    0x05, 0x01,       //   Usage Page (Generic Desktop)
+    0x09, 0x33,       //   Usage (Rx)
+    0x09, 0x34,       //   Usage (Ry)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x26, 0xFF, 0x00, //   Logical Maximum (255)
+    0x75, 0x08,       //   Report Size (8)
+    0x95, 0x02,       //   Report Count (2)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    // timestamp, temperature, gyro, accel, battery and touchpad
+    // (zeros if the handshake failed)
+    0x06, 0x00, 0xFF, //   Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x21,       //   Usage (0x21)
+    0x95, 0x36,       //   Report Count (54)
+    0x81, 0x02,       //   Input (Data, Var, Abs)
+
+    0xC0              // End Collection
+};
+
+static bool ds4_init(uint16_t hid_cid)
+{
+    // reading the calibration report enables the 0x11 report
+    auto status = hid_host_send_get_report(hid_cid, HID_REPORT_TYPE_FEATURE, 0x02);
+    if(status != ERROR_CODE_SUCCESS)
+    {
+        printf("failed to request feature report %02x\n", status);
+        return false;
+    }
+
+    return true;
+}
+
+// skip report ID, forward everything else
+static const QuirkReportMode switch_pro_full{{0x30, 1, 48, 0x01, 48}, switch_pro_descriptor, sizeof(switch_pro_descriptor)};
+static const QuirkReportMode switch_pro_basic{{0x3F, 1, 11, 0x01, 11}, switch_pro_basic_descriptor, sizeof(switch_pro_basic_descriptor)};
+
+// skip report ID and two header bytes, the next 63 bytes match the USB report (the rest is padding and the CRC)
+// the basic 0x01 report only has sticks, buttons and triggers
+static const QuirkReportMode ds4_full{{0x11, 3, 63, 0x01, 63}, ds4_descriptor, sizeof(ds4_descriptor)};
+static const QuirkReportMode ds4_basic{{0x01, 1, 9, 0x01, 63}, ds4_descriptor, sizeof(ds4_descriptor)};
+
+static const DeviceQuirk quirks[]
+{
+    {"Switch Pro Controller", 0x057E, 0x2009, switch_pro_init, switch_pro_full, switch_pro_basic},
+    {"DualShock 4", 0x054C, 0x05C4, ds4_init, ds4_full, ds4_basic},
+    {"DualShock 4 v2", 0x054C, 0x09CC, ds4_init, ds4_full, ds4_basic},
+};
+
+const DeviceQuirk *quirk_find(uint16_t vid, uint16_t pid)
+{
+    for(auto &quirk : quirks)
+    {
+        if(quirk.vid == vid && quirk.pid == pid)
+            return &quirk;
+    }
+
+    return nullptr;
+}
+
+uint16_t quirk_translate_report(const QuirkReportMode *mode, const uint8_t *in, uint16_t in_len, uint8_t *out)
+{
+    auto &layout = mode->report;
+
+    // drop anything else (including the slow reports before init is done)
+    if(in_len < layout.offset + layout.length || in[0] != layout.in_report_id)
+        return 0;
+
+    out[0] = layout.out_report_id;
+    memcpy(out + 1, in + layout.offset, layout.length);
+    memset(out + 1 + layout.length, 0, layout.out_length - layout.length);
+
+    return layout.out_length + 1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// which part of a device report to forward
+// offsets are from the report ID
+struct QuirkReportLayout
+{
+    uint8_t in_report_id;
+    uint8_t offset;
+    uint8_t length;
+    uint8_t out_report_id;
+    uint8_t out_length; // zero padded from length, not including the ID
+};
+
+// a report to forward and the descriptor for the translated report
+struct QuirkReportMode
+{
+    QuirkReportLayout report;
+
+    const uint8_t *descriptor;
+    uint16_t descriptor_len;
+};
+
+// devices that need a handshake before sending full rate reports
+// (the device's own descriptors declare reports too large for the endpoint)
+struct DeviceQuirk
+{
+    const char *name;
+    uint16_t vid, pid;
+
+    // called once connected and the vid/pid is known
+    // returns false if the handshake couldn't be sent
+    bool (*init)(uint16_t hid_cid);
+
+    QuirkReportMode full;  // after the handshake
+    QuirkReportMode basic; // what the device sends without it, used if init fails
+};
+
+const DeviceQuirk *quirk_find(uint16_t vid, uint16_t pid);
+
+// returns translated length, 0 if the report should be dropped
+uint16_t quirk_translate_report(const QuirkReportMode *mode, const uint8_t *in, uint16_t in_len, uint8_t *out);
@@ -1,11 +1,31 @@
+#include <climits>
+
+#include "hardware/sync.h"
+#include "pico/time.h"
+
 #include "tusb.h"
 
+#include "hid_descriptor.hpp"
 #include "usb.hpp"
 
 extern uint8_t desc_configuration[];
 
-static uint8_t *report_data = nullptr;
-static int report_len = 0;
+struct QueuedReport
+{
+    uint8_t data[USB_MAX_REPORT_SIZE];
+    uint16_t len;
+    uint32_t time;
+};
+
+// reports are queued from the bt handler, which may run in an irq
+static QueuedReport report_queue[USB_REPORT_QUEUE_SIZE];
+static unsigned report_queue_read = 0;
+static unsigned report_queue_count = 0;
+
+static unsigned report_queue_depth = 1;
+static ReportPolicy report_policy = ReportPolicy::DropNew;
+
+static USBStats stats{0, 0, 0, 0, UINT32_MAX, 0, 0};
 
 static const uint8_t *hid_desc = nullptr;
 
@@ -21,12 +41,36 @@ void usb_update()
     tud_task();
 
     // send report
-    if(report_data && tud_connected())
+    if(report_queue_count && tud_hid_ready())
     {
-        tud_hid_report(0, report_data, report_len);
-    
-        delete[] report_data;
-        report_data = nullptr;
+        QueuedReport report;
+
+        auto irq_state = save_and_disable_interrupts();
+        report = report_queue[report_queue_read];
+        report_queue_read = (report_queue_read + 1) % USB_REPORT_QUEUE_SIZE;
+        report_queue_count--;
+        restore_interrupts(irq_state);
+
+        bool sent = tud_hid_report(0, report.data, report.len);
+        auto latency = time_us_32() - report.time;
+
+        // stats are also updated from the bt irq
+        irq_state = save_and_disable_interrupts();
+
+        if(sent)
+        {
+            stats.reports_sent++;
+            stats.latency_total_us += latency;
+
+            if(latency < stats.latency_min_us)
+                stats.latency_min_us = latency;
+            if(latency > stats.latency_max_us)
+                stats.latency_max_us = latency;
+        }
+        else
+            stats.reports_dropped++;
+
+        restore_interrupts(irq_state);
     }
 }
 
@@ -43,26 +87,136 @@ uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
     return hid_desc;
 }
 
-void usb_set_hid_descriptor(const uint8_t *data, uint16_t len)
+bool usb_set_hid_descriptor(const uint8_t *data, uint16_t len)
 {
+    HIDDescriptorInfo info;
+    if(!hid_parse_descriptor(data, len, info))
+        return false;
+
+    if(info.max_input_size + (info.has_report_ids ? 1 : 0) > USB_MAX_REPORT_SIZE)
+        return false;
+
     // set report descriptor len
     desc_configuration[25] = len;
     desc_configuration[26] = len >> 8;
 
     hid_desc = data;
+
+    return true;
 }
 
 void usb_queue_report(const uint8_t *data, uint16_t len)
 {
-    // TODO: actually queue
-    if(report_data)
-        printf("dropping report!\n");
+    auto irq_state = save_and_disable_interrupts();
+
+    if(len > USB_MAX_REPORT_SIZE)
+    {
+        stats.reports_dropped++;
+        restore_interrupts(irq_state);
+        return;
+    }
+
+    unsigned index;
+    bool coalesce = false;
+
+    if(report_queue_count < report_queue_depth)
+    {
+        index = (report_queue_read + report_queue_count) % USB_REPORT_QUEUE_SIZE;
+        report_queue_count++;
+    }
+    else if(report_policy == ReportPolicy::DropOld)
+    {
+        index = (report_queue_read + report_queue_count) % USB_REPORT_QUEUE_SIZE;
+        report_queue_read = (report_queue_read + 1) % USB_REPORT_QUEUE_SIZE;
+        stats.reports_dropped++;
+    }
+    else if(report_policy == ReportPolicy::Coalesce)
+    {
+        index = (report_queue_read + report_queue_count - 1) % USB_REPORT_QUEUE_SIZE;
+        coalesce = true;
+        stats.reports_coalesced++;
+    }
     else
     {
-        report_data = new uint8_t[len];
-        report_len = len;
-        memcpy(report_data, data, len);
+        stats.reports_dropped++;
+        restore_interrupts(irq_state);
+        return;
     }
+
+    auto &report = report_queue[index];
+    memcpy(report.data, data, len);
+    report.len = len;
+
+    // latency is from when the report first entered the queue
+    if(!coalesce)
+        report.time = time_us_32();
+
+    stats.reports_queued++;
+
+    restore_interrupts(irq_state);
+}
+
+bool usb_report_queue_empty()
+{
+    return report_queue_count == 0;
+}
+
+void usb_count_coalesced_report()
+{
+    auto irq_state = save_and_disable_interrupts();
+    stats.reports_coalesced++;
+    restore_interrupts(irq_state);
+}
+
+void usb_set_report_policy(ReportPolicy policy)
+{
+    report_policy = policy;
+}
+
+ReportPolicy usb_get_report_policy()
+{
+    return report_policy;
+}
+
+bool usb_set_report_queue_depth(unsigned depth)
+{
+    if(depth < 1 || depth > USB_REPORT_QUEUE_SIZE)
+        return false;
+
+    auto irq_state = save_and_disable_interrupts();
+
+    // drop anything that no longer fits
+    while(report_queue_count > depth)
+    {
+        report_queue_read = (report_queue_read + 1) % USB_REPORT_QUEUE_SIZE;
+        report_queue_count--;
+        stats.reports_dropped++;
+    }
+
+    report_queue_depth = depth;
+
+    restore_interrupts(irq_state);
+
+    return true;
+}
+
+unsigned usb_get_report_queue_depth()
+{
+    return report_queue_depth;
+}
+
+void usb_get_stats(USBStats &out_stats)
+{
+    auto irq_state = save_and_disable_interrupts();
+    out_stats = stats;
+    restore_interrupts(irq_state);
+}
+
+void usb_reset_stats()
+{
+    auto irq_state = save_and_disable_interrupts();
+    stats = {0, 0, 0, 0, UINT32_MAX, 0, 0};
+    restore_interrupts(irq_state);
 }
 
 void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint8_t len)
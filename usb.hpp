@@ -1,10 +1,56 @@
 #pragma once
 
+#include <cstdint>
+
+#include "tusb_option.h" // CFG_TUD_HID_EP_BUFSIZE
+
+#define USB_REPORT_QUEUE_SIZE 8
+
+// report ID (if any) + data, anything larger would be truncated by the endpoint
+// (should only be hit by a broken device, the endpoint is the max size)
+#define USB_MAX_REPORT_SIZE CFG_TUD_HID_EP_BUFSIZE
+
+// what to do with a new report when the queue is full
+enum class ReportPolicy : uint8_t
+{
+    DropNew = 0, // keep what's queued, drop the new report
+    DropOld,     // drop the oldest queued report
+    Coalesce,    // overwrite the newest queued report
+};
+
+struct USBStats
+{
+    uint32_t reports_queued;
+    uint32_t reports_sent;
+    uint32_t reports_dropped;
+    uint32_t reports_coalesced;
+
+    // queue -> endpoint latency
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint32_t latency_total_us;
+};
+
 void usb_init();
 
 void usb_update();
 
 void usb_set_connected(bool connected);
 
-void usb_set_hid_descriptor(const uint8_t *data, uint16_t len);
-void usb_queue_report(const uint8_t *data, uint16_t len);
\ No newline at end of file
+// returns false if the descriptor is malformed or has input reports larger than USB_MAX_REPORT_SIZE
+bool usb_set_hid_descriptor(const uint8_t *data, uint16_t len);
+void usb_queue_report(const uint8_t *data, uint16_t len);
+bool usb_report_queue_empty();
+
+// for reports coalesced before reaching the queue
+void usb_count_coalesced_report();
+
+void usb_set_report_policy(ReportPolicy policy);
+ReportPolicy usb_get_report_policy();
+
+// max queued reports, 1 - USB_REPORT_QUEUE_SIZE
+bool usb_set_report_queue_depth(unsigned depth);
+unsigned usb_get_report_queue_depth();
+
+void usb_get_stats(USBStats &stats);
+void usb_reset_stats();